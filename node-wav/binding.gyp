@@ -0,0 +1,42 @@
+{
+  "variables": {
+    "library_type%": "loadable_module",
+  },
+  "targets": [
+    {
+      "target_name": "node-wav",
+      "type": "<(library_type)",
+      "sources": [
+        "src/bindings.cpp",
+        "src/codec.cpp",
+      ],
+      "include_dirs": [
+        "<!(node -e \"require('nan')\")",
+      ],
+      # The codecs must round exactly as the JavaScript ones do, without
+      # fusing multiplies and adds
+      "cflags": [
+        "-O3",
+        "-ffp-contract=off",
+      ],
+      "cflags_cc": [
+        "-std=c++11",
+      ],
+      "conditions": [
+        [ "OS=='android'", {
+          "libraries": [
+            "<!(echo $Android_mk__LIBRARIES)",
+          ],
+        }],
+        [ "OS=='mac'", {
+          "xcode_settings": {
+            "GCC_OPTIMIZATION_LEVEL": "3",
+            "OTHER_CFLAGS": [
+              "-ffp-contract=off",
+            ],
+          },
+        }],
+      ],
+    },
+  ],
+}
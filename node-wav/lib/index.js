@@ -2,6 +2,9 @@
  * @flow
  */
 
+const fs = require('mz/fs');
+const stream = require('stream');
+
 const dataDecoders = {
   pcm8: (buffer, offset, output, channels, samples) => {
     let input = new Uint8Array(buffer, offset);
@@ -136,6 +139,71 @@ const dataEncoders = {
   },
 };
 
+const sampleBytes = {
+  pcm8: 1,
+  pcm16: 2,
+  pcm24: 3,
+  pcm32: 4,
+  pcm32f: 4,
+  pcm64f: 8,
+};
+
+// The SIMD codecs of src/, when node-gyp built them.  They produce the same
+// bits as the codecs above, just several times faster.
+let native = null;
+try {
+  // $FlowFixMe: only there when the native codecs were built
+  native = require('../build/Release/node-wav.node'); //eslint-disable-line
+} catch (err) {
+  // Use the JavaScript codecs
+}
+
+/**
+ * Wraps the native codec |fn| into the signature of the JavaScript codecs,
+ * falling back to |fallback| for what it does not handle: data chunks that
+ * run past the end of the buffer, and channel data other than Float32Arrays.
+ */
+function nativeCodec(fn, fallback, bytes) {
+  return (buffer, offset, channelData, channels, samples) => {
+    let size = samples * channels * bytes;
+    if (offset + size > buffer.byteLength ||
+        !channelData.every((data) => data instanceof Float32Array && data.length >= samples)) {
+      fallback(buffer, offset, channelData, channels, samples);
+      return;
+    }
+    fn(new Uint8Array(buffer, offset, size), channelData, samples);
+  };
+}
+
+function nativeCodecs(codecs, fallbacks) {
+  let table = {};
+  Object.keys(fallbacks).forEach((name) => {
+    table[name] = nativeCodec(codecs[name], fallbacks[name], sampleBytes[name]);
+  });
+  return table;
+}
+
+let decoders = dataDecoders;
+let encoders = dataEncoders;
+
+/**
+ * Selects the native codecs if |enabled| and they were built, or the
+ * JavaScript ones.  The native codecs are used by default.  Returns whether
+ * the native codecs are in use.
+ */
+function useNative(enabled: boolean): boolean {
+  if (enabled && native) {
+    decoders = nativeCodecs(native.decoders, dataDecoders);
+    encoders = nativeCodecs(native.encoders, dataEncoders);
+    return true;
+  }
+  decoders = dataDecoders;
+  encoders = dataEncoders;
+  return false;
+}
+
+useNative(true);
+
 function lookup(table, bitDepth, floatingPoint) {
   let name = 'pcm' + bitDepth + (floatingPoint ? 'f' : '');
   let fn = table[name];
@@ -145,6 +213,22 @@ function lookup(table, bitDepth, floatingPoint) {
   return fn;
 }
 
+function decodeFormat(v, pos) {
+  let formatId = v.getUint16(pos, true);
+  if (formatId !== 0x0001 && formatId !== 0x0003) {
+    throw new TypeError('Unsupported format in WAV file: ' + formatId.toString(16));
+  }
+  return {
+    format: 'lpcm',
+    floatingPoint: formatId === 0x0003,
+    channels: v.getUint16(pos + 2, true),
+    sampleRate: v.getUint32(pos + 4, true),
+    byteRate: v.getUint32(pos + 8, true),
+    blockSize: v.getUint16(pos + 12, true),
+    bitDepth: v.getUint16(pos + 14, true),
+  };
+}
+
 function decodeHeader(v, pos, end) {
   function u8() {
     let x = v.getUint8(pos);
@@ -152,12 +236,6 @@ function decodeHeader(v, pos, end) {
     return x;
   }
 
-  function u16() {
-    let x = v.getUint16(pos, true);
-    pos += 2;
-    return x;
-  }
-
   function u32() {
     let x = v.getUint32(pos, true);
     pos += 4;
@@ -187,22 +265,9 @@ function decodeHeader(v, pos, end) {
     let size = u32();
     let next = pos + size;
     switch (type) {
-    case 'fmt ': {
-      let formatId = u16();
-      if (formatId !== 0x0001 && formatId !== 0x0003) {
-        throw new TypeError('Unsupported format in WAV file: ' + formatId.toString(16));
-      }
-      fmt = {
-        format: 'lpcm',
-        floatingPoint: formatId === 0x0003,
-        channels: u16(),
-        sampleRate: u32(),
-        byteRate: u32(),
-        blockSize: u16(),
-        bitDepth: u16(),
-      };
+    case 'fmt ':
+      fmt = decodeFormat(v, pos);
       break;
-    }
     case 'data': {
       if (!fmt) {
         throw new TypeError('Missing "fmt " chunk.');
@@ -243,7 +308,7 @@ function decode(buffer: ArrayBuffer | $TypedArray): DecodeReturnType {
     // If we are handed a typed array or a buffer, then we have to consider the
     // offset and length into the underlying array buffer.
     pos = buffer.byteOffset;
-    end = buffer.length;
+    end = buffer.byteOffset + buffer.byteLength;
     buffer = buffer.buffer;
   }
 
@@ -261,7 +326,7 @@ function decode(buffer: ArrayBuffer | $TypedArray): DecodeReturnType {
   for (let ch = 0; ch < fmt.channels; ++ch) {
     channelData[ch] = new Float32Array(samples);
   }
-  let decodeData = lookup(dataDecoders, fmt.bitDepth, fmt.floatingPoint);
+  let decodeData = lookup(decoders, fmt.bitDepth, fmt.floatingPoint);
   decodeData(buffer, pos, channelData, fmt.channels, samples);
 
   return {
@@ -292,7 +357,7 @@ function decodeRaw(buffer: ArrayBuffer | $TypedArray): DecodeRawReturnType {
     // If we are handed a typed array or a buffer, then we have to consider the
     // offset and length into the underlying array buffer.
     pos = buffer.byteOffset;
-    end = buffer.length;
+    end = buffer.byteOffset + buffer.byteLength;
     buffer = buffer.buffer;
   }
 
@@ -382,7 +447,7 @@ function encode(
   let bitDepth = floatingPoint ? 32 : ((opts.bitDepth | 0) || 16);
   let channels = channelData.length;
   let samples = channelData[0].length;
-  let encodeData = lookup(dataEncoders, bitDepth, floatingPoint);
+  let encodeData = lookup(encoders, bitDepth, floatingPoint);
 
   if (channels < 1 || channels > 3) {
     throw new Error(`Atleast 1 channel needs to be specified`);
@@ -427,9 +492,495 @@ function encodeRaw(channelData: Buffer, opts: EncodeOptionsType): Buffer {
   return Buffer.concat([Buffer.from(header), channelData]);
 }
 
+/**
+ * Decodes |frames| frames of |fmt| data found at |pos| in |buffer| into
+ * |channelData|
+ */
+function decodeFrames(
+  fmt: Object,
+  buffer: Buffer,
+  pos: number,
+  channelData: Array<Float32Array>,
+  frames: number
+) {
+  let decodeData = lookup(decoders, fmt.bitDepth, fmt.floatingPoint);
+  let offset = buffer.byteOffset + pos;
+  if (offset % 8 !== 0) {
+    // The JavaScript decoders view the data through typed arrays, which must
+    // be aligned to their element size
+    buffer = Buffer.from(buffer.slice(pos, pos + frames * frameBytes(fmt)));
+    offset = buffer.byteOffset;
+  }
+  decodeData(buffer.buffer, offset, channelData, fmt.channels, frames);
+}
+
+function frameBytes(fmt: Object): number {
+  return fmt.channels * (fmt.bitDepth >> 3);
+}
+
+const EMPTY = Buffer.alloc(0);
+
+// ChunkParser states
+const RIFF_HEADER = 0;
+const CHUNK_HEADER = 1;
+const DATA = 2;
+const DONE = 3;
+
+/**
+ * Incremental WAV parser, fed a file in pieces of any size as they are read.
+ * RIFF chunks may be split anywhere between two pieces.  Only a partial chunk
+ * header, the 'fmt ' chunk or a partial frame is held on to between pieces,
+ * so memory use does not grow with the length of the file.
+ */
+class ChunkParser {
+  format: ?Object;
+  dataOffset: number;
+  dataSize: number;
+  _state: number;
+  _pending: Buffer;
+  _offset: number;
+  _skip: number;
+  _remaining: number;
+
+  constructor() {
+    this.format = null;
+    this.dataOffset = 0; // File offset of the first sample
+    this.dataSize = 0; // Bytes of samples, Infinity if the header has no size
+    this._state = RIFF_HEADER;
+    this._pending = EMPTY;
+    this._offset = 0; // File offset of the first byte of |_pending|
+    this._skip = 0; // Bytes of an ignored chunk still to skip
+    this._remaining = 0; // Bytes of samples still to decode
+  }
+
+  /**
+   * Whether the header was parsed and the samples start at |dataOffset|
+   */
+  get ready(): boolean {
+    return this._state >= DATA;
+  }
+
+  /**
+   * Parses the next |chunk| of the file, returning the samples of the
+   * complete frames decoded so far, if any
+   */
+  push(chunk: Buffer): ?Array<Float32Array> {
+    let buffer = this._pending.length > 0 ? Buffer.concat([this._pending, chunk]) : chunk;
+    let pos = 0;
+
+    while (this._state === RIFF_HEADER || this._state === CHUNK_HEADER) {
+      if (this._skip > 0) {
+        let skipped = Math.min(this._skip, buffer.length - pos);
+        this._skip -= skipped;
+        pos += skipped;
+        if (this._skip > 0) {
+          break;
+        }
+      }
+
+      if (this._state === RIFF_HEADER) {
+        if (buffer.length - pos < 12) {
+          break;
+        }
+        if (buffer.toString('ascii', pos, pos + 4) !== 'RIFF' ||
+            buffer.toString('ascii', pos + 8, pos + 12) !== 'WAVE') {
+          throw new TypeError('Invalid WAV file');
+        }
+        pos += 12;
+        this._state = CHUNK_HEADER;
+        continue;
+      }
+
+      if (buffer.length - pos < 8) {
+        break;
+      }
+      let type = buffer.toString('ascii', pos, pos + 4);
+      let size = buffer.readUInt32LE(pos + 4);
+      if (type === 'fmt ') {
+        if (buffer.length - pos < 8 + size) {
+          break; // Wait for the rest of the chunk
+        }
+        this.format = decodeFormat(
+          new DataView(buffer.buffer, buffer.byteOffset + pos + 8, size),
+          0
+        );
+        pos += 8 + size;
+      } else if (type === 'data') {
+        let fmt = this.format;
+        if (!fmt) {
+          throw new TypeError('Missing "fmt " chunk.');
+        }
+        if (frameBytes(fmt) === 0) {
+          throw new TypeError('Invalid WAV file');
+        }
+        lookup(decoders, fmt.bitDepth, fmt.floatingPoint); // Throws if unsupported
+        pos += 8;
+        this.dataOffset = this._offset + pos;
+        // Writers that stream to a pipe cannot patch the size in afterwards
+        this.dataSize = size === 0xffffffff ? Infinity : size;
+        this._remaining = this.dataSize;
+        this._state = DATA;
+      } else if (type === 'FLLR' || type === 'LIST') {
+        pos += 8;
+        this._skip = size;
+      } else {
+        throw new TypeError(`Invalid sub chunk type ${type}`);
+      }
+    }
+
+    let channelData = null;
+    let fmt = this.format;
+    if (this._state === DATA && fmt) {
+      let bytesPerFrame = frameBytes(fmt);
+      let frames = Math.floor(Math.min(buffer.length - pos, this._remaining) / bytesPerFrame);
+      if (frames > 0) {
+        channelData = [];
+        for (let ch = 0; ch < fmt.channels; ++ch) {
+          channelData[ch] = new Float32Array(frames);
+        }
+        decodeFrames(fmt, buffer, pos, channelData, frames);
+        pos += frames * bytesPerFrame;
+        this._remaining -= frames * bytesPerFrame;
+      }
+      if (this._remaining < bytesPerFrame) {
+        this._state = DONE; // Anything after the data chunk is of no interest
+      }
+    }
+
+    this._offset += pos;
+    if (this._state === DONE || pos === buffer.length) {
+      this._pending = EMPTY;
+    } else {
+      // Copy, so as not to keep the whole of |chunk| alive
+      this._pending = Buffer.from(buffer.slice(pos));
+    }
+    return channelData;
+  }
+}
+
+type FormatType = {
+  sampleRate: number;
+  channels: number;
+  bitDepth: number;
+  float: boolean;
+};
+
+function formatOf(fmt: Object): FormatType {
+  return {
+    sampleRate: fmt.sampleRate,
+    channels: fmt.channels,
+    bitDepth: fmt.bitDepth,
+    float: fmt.floatingPoint,
+  };
+}
+
+/**
+ * Decodes a WAV file piped into it as it arrives.  Emits 'format' with the
+ * sampleRate, channels, bitDepth and float of the file once its header is
+ * parsed, then reads as an object stream of channel data, that is one
+ * Array<Float32Array> per block of samples.
+ */
+class DecodeStream extends stream.Transform {
+  format: ?FormatType;
+  _parser: ChunkParser;
+
+  constructor() {
+    super({readableObjectMode: true});
+    this.format = null;
+    this._parser = new ChunkParser();
+  }
+
+  _transform(chunk: Buffer, encoding: string, callback: Function) {
+    let channelData;
+    try {
+      channelData = this._parser.push(chunk);
+    } catch (err) {
+      callback(err);
+      return;
+    }
+    if (!this.format && this._parser.ready && this._parser.format) {
+      this.format = formatOf(this._parser.format);
+      this.emit('format', this.format);
+    }
+    if (channelData) {
+      this.push(channelData);
+    }
+    callback();
+  }
+
+  _flush(callback: Function) {
+    callback(this._parser.ready ? null : new Error('Failed to decode'));
+  }
+}
+
+// How much of a file to read at a time looking for its data chunk
+const HEADER_READ_SIZE = 4096;
+
+/**
+ * Random access to the samples of a WAV file.  Only the frames asked for are
+ * read from the file, into a scratch buffer reused from one read to the next,
+ * so seeking costs the same anywhere in the file and memory use depends on
+ * the size of the reads rather than the length of the file.
+ */
+class WavReader {
+  sampleRate: number;
+  channels: number;
+  bitDepth: number;
+  float: boolean;
+  length: number;
+  _fd: ?number;
+  _fmt: Object;
+  _dataOffset: number;
+  _scratch: Buffer;
+  _queue: Promise<mixed>;
+
+  /**
+   * Opens the WAV file at |path|
+   */
+  static async open(path: string): Promise<WavReader> {
+    let fd = await fs.open(path, 'r');
+    try {
+      let parser = new ChunkParser();
+      let chunk = Buffer.alloc(HEADER_READ_SIZE);
+      let pos = 0;
+      while (!parser.ready) {
+        let [bytesRead] = await fs.read(fd, chunk, 0, chunk.length, pos);
+        if (bytesRead === 0) {
+          throw new Error('Failed to decode');
+        }
+        parser.push(chunk.slice(0, bytesRead));
+        pos += bytesRead;
+      }
+      let stats = await fs.fstat(fd);
+      return new WavReader(fd, parser, stats.size);
+    } catch (err) {
+      await fs.close(fd);
+      throw err;
+    }
+  }
+
+  constructor(fd: number, parser: ChunkParser, fileSize: number) {
+    let fmt = parser.format;
+    if (!fmt) {
+      throw new Error('Failed to decode');
+    }
+    let bytes = Math.min(parser.dataSize, fileSize - parser.dataOffset);
+    Object.assign(this, formatOf(fmt));
+    this.length = Math.max(0, Math.floor(bytes / frameBytes(fmt))); // In frames
+    this._fd = fd;
+    this._fmt = fmt;
+    this._dataOffset = parser.dataOffset;
+    this._scratch = EMPTY;
+    this._queue = Promise.resolve();
+  }
+
+  /**
+   * Decodes up to |frames| frames from frame |start| on.  The samples are
+   * written to the start of the Float32Arrays of |channelData| if given,
+   * reading no more frames than they hold, or else to new ones.  Resolves to
+   * the channel data, each channel as long as the number of frames read.
+   */
+  read(
+    start: number,
+    frames: number,
+    channelData?: Array<Float32Array>
+  ): Promise<Array<Float32Array>> {
+    let result = this._queue.then(() => this._read(start, frames, channelData));
+    this._queue = result.catch(() => {});
+    return result;
+  }
+
+  async _read(
+    start: number,
+    frames: number,
+    channelData?: Array<Float32Array>
+  ): Promise<Array<Float32Array>> {
+    let fd = this._fd;
+    if (fd === null || fd === undefined) {
+      throw new Error('WavReader is closed');
+    }
+    if (!(start >= 0)) {
+      throw new RangeError(`Invalid start frame ${start}`);
+    }
+    start = Math.floor(start);
+    frames = Math.max(0, Math.min(Math.floor(frames), this.length - start));
+    if (channelData) {
+      if (channelData.length !== this.channels) {
+        throw new TypeError(`Expected channel data for ${this.channels} channels`);
+      }
+      for (let data of channelData) {
+        frames = Math.min(frames, data.length);
+      }
+    }
+
+    let bytesPerFrame = frameBytes(this._fmt);
+    let bytes = frames * bytesPerFrame;
+    if (this._scratch.length < bytes) {
+      this._scratch = Buffer.alloc(bytes);
+    }
+    let position = this._dataOffset + start * bytesPerFrame;
+    let filled = 0;
+    while (filled < bytes) {
+      let [bytesRead] = await fs.read(fd, this._scratch, filled, bytes - filled, position + filled);
+      if (bytesRead === 0) {
+        break; // The file was truncated since it was opened
+      }
+      filled += bytesRead;
+    }
+    frames = Math.floor(filled / bytesPerFrame);
+
+    let output = [];
+    for (let ch = 0; ch < this.channels; ++ch) {
+      output[ch] = channelData ?
+        channelData[ch].subarray(0, frames) :
+        new Float32Array(frames);
+    }
+    decodeFrames(this._fmt, this._scratch, 0, output, frames);
+    return output;
+  }
+
+  /**
+   * Closes the file, once the reads already asked for are done
+   */
+  async close(): Promise<void> {
+    await this._queue;
+    let fd = this._fd;
+    this._fd = null;
+    if (fd !== null && fd !== undefined) {
+      await fs.close(fd);
+    }
+  }
+}
+
+const HEADER_SIZE = 44;
+
+async function writeFully(fd: number, buffer: Buffer, length: number, position: number) {
+  let written = 0;
+  while (written < length) {
+    let [bytesWritten] = await fs.write(fd, buffer, written, length - written, position + written);
+    written += bytesWritten;
+  }
+}
+
+/**
+ * Encodes a WAV file block by block as the samples become available.  The
+ * header goes out with the first block and is rewritten with the final sizes
+ * on close(), so the samples written so far are all that is ever in memory.
+ */
+class WavWriter {
+  sampleRate: number;
+  channels: number;
+  bitDepth: number;
+  float: boolean;
+  _fd: ?number;
+  _dataSize: number;
+  _headerWritten: boolean;
+  _scratch: Buffer;
+  _queue: Promise<mixed>;
+
+  /**
+   * Creates or truncates the WAV file at |path|, for |opts.channels| channels
+   * of samples (1 by default) in the format of |opts|
+   */
+  static async open(path: string, opts: EncodeOptionsType): Promise<WavWriter> {
+    let writer = new WavWriter(opts);
+    writer._fd = await fs.open(path, 'w');
+    return writer;
+  }
+
+  constructor(opts: EncodeOptionsType) {
+    this.sampleRate = opts.sampleRate || 16000;
+    this.float = !!opts.float;
+    this.bitDepth = this.float ? 32 : ((opts.bitDepth | 0) || 16);
+    this.channels = opts.channels || 1;
+    lookup(encoders, this.bitDepth, this.float); // Throws if unsupported
+
+    if (this.channels < 1 || this.channels > 3) {
+      throw new Error(`Atleast 1 channel needs to be specified`);
+    }
+
+    this._fd = null;
+    this._dataSize = 0;
+    this._headerWritten = false;
+    this._scratch = EMPTY;
+    this._queue = Promise.resolve();
+  }
+
+  /**
+   * Appends the samples of |channelData|, one Float32Array per channel
+   */
+  write(channelData: Array<Float32Array>): Promise<void> {
+    let result = this._queue.then(() => this._write(channelData));
+    this._queue = result.catch(() => {});
+    return result;
+  }
+
+  async _write(channelData: Array<Float32Array>): Promise<void> {
+    let fd = this._fd;
+    if (fd === null || fd === undefined) {
+      throw new Error('WavWriter is closed');
+    }
+    if (channelData.length !== this.channels) {
+      throw new TypeError(`Expected channel data for ${this.channels} channels`);
+    }
+    let frames = channelData[0].length;
+    let bytes = frames * this.channels * (this.bitDepth >> 3);
+    if (HEADER_SIZE + this._dataSize + bytes > 0xffffffff) {
+      throw new RangeError('WAV files cannot exceed 4GB');
+    }
+    if (!this._headerWritten) {
+      await this._writeHeader(fd);
+    }
+
+    if (this._scratch.length < bytes) {
+      this._scratch = Buffer.alloc(bytes);
+    }
+    let encodeData = lookup(encoders, this.bitDepth, this.float);
+    encodeData(this._scratch.buffer, this._scratch.byteOffset, channelData, this.channels, frames);
+    await writeFully(fd, this._scratch, bytes, HEADER_SIZE + this._dataSize);
+    this._dataSize += bytes;
+  }
+
+  async _writeHeader(fd: number): Promise<void> {
+    let header = Buffer.alloc(HEADER_SIZE);
+    encodeHeader(
+      new DataView(header.buffer, header.byteOffset, HEADER_SIZE),
+      this.float,
+      this.channels,
+      this.sampleRate,
+      this.bitDepth,
+      HEADER_SIZE + this._dataSize
+    );
+    await writeFully(fd, header, HEADER_SIZE, 0);
+    this._headerWritten = true;
+  }
+
+  /**
+   * Patches the header with the final sizes and closes the file, once the
+   * writes already asked for are done
+   */
+  async close(): Promise<void> {
+    await this._queue;
+    let fd = this._fd;
+    if (fd === null || fd === undefined) {
+      return;
+    }
+    this._fd = null;
+    try {
+      await this._writeHeader(fd);
+    } finally {
+      await fs.close(fd);
+    }
+  }
+}
+
 module.exports = {
+  DecodeStream: DecodeStream,
+  WavReader: WavReader,
+  WavWriter: WavWriter,
   decode: decode,
   decodeRaw: decodeRaw,
   encode: encode,
   encodeRaw: encodeRaw,
+  useNative: useNative,
 };
@@ -0,0 +1,109 @@
+#include <nan.h>
+#include <vector>
+
+#include "codec.h"
+
+using v8::Array;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+using Nan::FunctionCallbackInfo;
+using Nan::ThrowRangeError;
+using Nan::ThrowTypeError;
+using Nan::To;
+using Nan::TypedArrayContents;
+using Nan::Undefined;
+
+// Get an argument
+static Local<Value> Arg(const FunctionCallbackInfo<Value>& info, int n) {
+  if (n < info.Length()) {
+    return info[n];
+  }
+  return Undefined();
+}
+
+// Get the samples of each Float32Array of |array|, holding at least |samples|
+static bool ChannelData(
+  Local<Value> array,
+  uint32_t samples,
+  std::vector<float *> *channels
+) {
+  if (!array->IsArray()) {
+    return false;
+  }
+  Local<Array> channelData = array.As<Array>();
+  for (uint32_t ch = 0; ch < channelData->Length(); ch++) {
+    Local<Value> channel = Nan::Get(channelData, ch).ToLocalChecked();
+    if (!channel->IsFloat32Array()) {
+      return false;
+    }
+    TypedArrayContents<float> contents(channel);
+    if (contents.length() < samples) {
+      return false;
+    }
+    channels->push_back(*contents);
+  }
+  return !channels->empty();
+}
+
+// decode(data: Uint8Array, channelData: Array<Float32Array>, samples: number)
+template <wav::Format format>
+static NAN_METHOD(Decode) {
+  uint32_t samples = To<uint32_t>(Arg(info, 2)).FromMaybe(0);
+  std::vector<float *> out;
+  if (!Arg(info, 0)->IsUint8Array()) {
+    return ThrowTypeError("missing input array");
+  }
+  if (!ChannelData(Arg(info, 1), samples, &out)) {
+    return ThrowTypeError("channel data must be Float32Arrays of every sample");
+  }
+  TypedArrayContents<uint8_t> in(Arg(info, 0));
+  if (in.length() < uint64_t(samples) * out.size() * wav::formatBytes(format)) {
+    return ThrowRangeError("input array too short");
+  }
+  wav::decode(format, *in, out.data(), out.size(), samples);
+}
+
+// encode(data: Uint8Array, channelData: Array<Float32Array>, samples: number)
+template <wav::Format format>
+static NAN_METHOD(Encode) {
+  uint32_t samples = To<uint32_t>(Arg(info, 2)).FromMaybe(0);
+  std::vector<float *> in;
+  if (!Arg(info, 0)->IsUint8Array()) {
+    return ThrowTypeError("missing output array");
+  }
+  if (!ChannelData(Arg(info, 1), samples, &in)) {
+    return ThrowTypeError("channel data must be Float32Arrays of every sample");
+  }
+  TypedArrayContents<uint8_t> out(Arg(info, 0));
+  if (out.length() < uint64_t(samples) * in.size() * wav::formatBytes(format)) {
+    return ThrowRangeError("output array too short");
+  }
+  wav::encode(format, in.data(), in.size(), samples, *out);
+}
+
+template <wav::Format format>
+static void SetCodec(
+  Local<Object> decoders,
+  Local<Object> encoders,
+  const char *name
+) {
+  Nan::SetMethod(decoders, name, Decode<format>);
+  Nan::SetMethod(encoders, name, Encode<format>);
+}
+
+NAN_MODULE_INIT(Init) {
+  Local<Object> decoders = Nan::New<Object>();
+  Local<Object> encoders = Nan::New<Object>();
+  SetCodec<wav::PCM8>(decoders, encoders, "pcm8");
+  SetCodec<wav::PCM16>(decoders, encoders, "pcm16");
+  SetCodec<wav::PCM24>(decoders, encoders, "pcm24");
+  SetCodec<wav::PCM32>(decoders, encoders, "pcm32");
+  SetCodec<wav::PCM32F>(decoders, encoders, "pcm32f");
+  SetCodec<wav::PCM64F>(decoders, encoders, "pcm64f");
+  Nan::Set(target, Nan::New("decoders").ToLocalChecked(), decoders);
+  Nan::Set(target, Nan::New("encoders").ToLocalChecked(), encoders);
+}
+
+NODE_MODULE(wav, Init)
@@ -0,0 +1,800 @@
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "codec.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WAV_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define WAV_SSE2
+#endif
+
+namespace wav {
+
+namespace {
+
+// Samples converted at a time when (de)interleaving
+const size_t BlockSamples = 1024;
+
+/**
+ * Negative samples of an n bit format decode to x / 2^(n-1) and positive ones
+ * to x / (2^(n-1) - 1), in double precision.  The reciprocal of the latter is
+ * split in two, hi with few enough bits that x * hi is exact, and for every x
+ * of 8, 16 or 24 bits x * hi + x * lo rounds to the very same float (fused or
+ * not), without a division.
+ */
+struct Reciprocal {
+  float neg;
+  float hi;
+  float lo;
+};
+
+Reciprocal reciprocal(int bits) {
+  double r = 1.0 / ((1 << (bits - 1)) - 1);
+  int exponent;
+  frexp(r, &exponent);
+  double unit = ldexp(1.0, exponent - (25 - bits));
+  Reciprocal result;
+  result.neg = ldexp(1.0, 1 - bits);
+  result.hi = floor(r / unit) * unit;
+  result.lo = r - result.hi;
+  return result;
+}
+
+const Reciprocal Pcm8 = reciprocal(8);
+const Reciprocal Pcm16 = reciprocal(16);
+const Reciprocal Pcm24 = reciprocal(24);
+
+// v * 0.5 + 0.5 rounds to 0.5 in double precision for |v| <= 2^-54, so the
+// pcm8 encoder takes those as 0
+const float Pcm8Epsilon = 1.0f / (1LL << 54);
+
+//
+// The JavaScript codecs, one sample at a time
+//
+
+inline int16_t load16(const uint8_t *p) {
+  int16_t x;
+  memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+inline int32_t load32(const uint8_t *p) {
+  int32_t x;
+  memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+inline float decode8(uint8_t x) {
+  int data = x - 128;
+  return data < 0 ? data / 128.0 : data / 127.0;
+}
+
+inline float decode16(int16_t data) {
+  return data < 0 ? data / 32768.0 : data / 32767.0;
+}
+
+inline float decode24(const uint8_t *p) {
+  int32_t xx = p[0] + (p[1] << 8) + (p[2] << 16);
+  // Note 0x800000 itself is taken as positive
+  int32_t data = xx > 0x800000 ? xx - 0x1000000 : xx;
+  return data < 0 ? data / 8388608.0 : data / 8388607.0;
+}
+
+inline float decode32(int32_t data) {
+  return data < 0 ? data / 2147483648.0 : data / 2147483647.0;
+}
+
+// Math.max(-1, Math.min(x, 1)), which keeps NaN
+inline double clamp(float x) {
+  return x < -1 ? -1 : (x > 1 ? 1 : x);
+}
+
+// |0 of a number known to be within range of an int32
+inline int32_t toInt32(double v) {
+  return v == v ? static_cast<int32_t>(v) : 0;
+}
+
+inline uint8_t encode8(float x) {
+  double v = clamp(x);
+  return toInt32((v * 0.5 + 0.5) * 255 + 0.5);
+}
+
+inline int16_t encode16(float x) {
+  double v = clamp(x);
+  return toInt32(v < 0 ? v * 32768 - 0.5 : v * 32767 + 0.5);
+}
+
+inline void encode24(float x, uint8_t *p) {
+  double v = clamp(x);
+  int32_t data = toInt32(
+    v < 0 ? 0x1000000 + v * 8388608 + 0.5 : v * 8388607 + 0.5
+  );
+  p[0] = data;
+  p[1] = data >> 8;
+  p[2] = data >> 16;
+}
+
+inline int32_t encode32(float x) {
+  double v = clamp(x);
+  return toInt32(v < 0 ? v * 2147483648.0 - 0.5 : v * 2147483647.0 + 0.5);
+}
+
+//
+// Vector helpers.  The encoders round in single precision using the identity
+// v * (2^(n-1) - 1) = v * 2^(n-1) - v: a = v * 2^(n-1) is exact, and so is its
+// fraction f = a - trunc(a), which leaves comparisons of f, v and 1/2 to
+// settle which way the sample rounds.
+//
+
+#if defined(WAV_NEON)
+
+inline float32x4_t scale(int32x4_t data, const Reciprocal &r) {
+  float32x4_t x = vcvtq_f32_s32(data);
+  float32x4_t neg = vmulq_f32(x, vdupq_n_f32(r.neg));
+  float32x4_t pos = vaddq_f32(
+    vmulq_f32(x, vdupq_n_f32(r.hi)),
+    vmulq_f32(x, vdupq_n_f32(r.lo))
+  );
+  return vbslq_f32(vcltq_s32(data, vdupq_n_s32(0)), neg, pos);
+}
+
+inline int32x4_t fixPcm24(int32x4_t data) {
+  return vbslq_s32(
+    vceqq_s32(data, vdupq_n_s32(-0x800000)),
+    vdupq_n_s32(0x800000),
+    data
+  );
+}
+
+inline float32x4_t clamp(float32x4_t x, float nan) {
+  x = vbslq_f32(vceqq_f32(x, x), x, vdupq_n_f32(nan));
+  return vminq_f32(vmaxq_f32(x, vdupq_n_f32(-1)), vdupq_n_f32(1));
+}
+
+/**
+ * The float formats are clamped on the bits, as NEON flushes subnormals to
+ * zero and turns NaN into the default NaN
+ */
+inline float32x4_t clampBits(float32x4_t x) {
+  uint32x4_t bits = vreinterpretq_u32_f32(x);
+  uint32x4_t magnitude = vandq_u32(bits, vdupq_n_u32(0x7fffffff));
+  uint32x4_t over = vandq_u32(
+    vcgtq_u32(magnitude, vdupq_n_u32(0x3f800000)),
+    vcleq_u32(magnitude, vdupq_n_u32(0x7f800000))
+  );
+  uint32x4_t one = vorrq_u32(
+    vandq_u32(bits, vdupq_n_u32(0x80000000)),
+    vdupq_n_u32(0x3f800000)
+  );
+  return vreinterpretq_f32_u32(vbslq_u32(over, one, bits));
+}
+
+inline uint32x4_t encodeVector8(float32x4_t x) {
+  float32x4_t v = clamp(x, -1);
+  v = vreinterpretq_f32_u32(vandq_u32(
+    vreinterpretq_u32_f32(v),
+    vcagtq_f32(v, vdupq_n_f32(Pcm8Epsilon))
+  ));
+
+  // (v * 0.5 + 0.5) * 255 + 0.5 = a + 128 - v / 2, with a = v * 128
+  float32x4_t a = vmulq_f32(v, vdupq_n_f32(128));
+  int32x4_t i = vcvtq_s32_f32(a);
+  float32x4_t f = vsubq_f32(a, vcvtq_f32_s32(i));
+  float32x4_t h = vmulq_f32(v, vdupq_n_f32(0.5f));
+  int32x4_t r = vaddq_s32(
+    vaddq_s32(i, vdupq_n_s32(128)),
+    vreinterpretq_s32_u32(vcltq_f32(f, h))
+  );
+  return vreinterpretq_u32_s32(r);
+}
+
+// |halfUp| selects rounding of negative samples half up, rather than half
+// away from zero
+inline int32x4_t encodeVector(float32x4_t x, float max, bool halfUp) {
+  float32x4_t v = clamp(x, 0);
+  float32x4_t a = vmulq_f32(v, vdupq_n_f32(max));
+  int32x4_t i = vcvtq_s32_f32(a);
+  float32x4_t f = vsubq_f32(a, vcvtq_f32_s32(i));
+  float32x4_t half = vdupq_n_f32(0.5f);
+
+  uint32x4_t up = vcgeq_f32(vsubq_f32(f, half), v);
+  uint32x4_t down = vcltq_f32(vaddq_f32(f, half), v);
+  int32x4_t pos = vaddq_s32(
+    vsubq_s32(i, vreinterpretq_s32_u32(up)),
+    vreinterpretq_s32_u32(down)
+  );
+  uint32x4_t below = halfUp ?
+    vcltq_f32(f, vdupq_n_f32(-0.5f)) :
+    vcleq_f32(f, vdupq_n_f32(-0.5f));
+  int32x4_t neg = vaddq_s32(i, vreinterpretq_s32_u32(below));
+  return vbslq_s32(vcltq_f32(v, vdupq_n_f32(0)), neg, pos);
+}
+
+#elif defined(WAV_SSE2)
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline __m128d select(__m128d mask, __m128d a, __m128d b) {
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+inline __m128 scale(__m128i data, const Reciprocal &r) {
+  __m128 x = _mm_cvtepi32_ps(data);
+  __m128 neg = _mm_mul_ps(x, _mm_set1_ps(r.neg));
+  __m128 pos = _mm_add_ps(
+    _mm_mul_ps(x, _mm_set1_ps(r.hi)),
+    _mm_mul_ps(x, _mm_set1_ps(r.lo))
+  );
+  return select(
+    _mm_castsi128_ps(_mm_cmplt_epi32(data, _mm_setzero_si128())),
+    neg,
+    pos
+  );
+}
+
+// Sign extends 8 16 bit lanes into two vectors of 4 32 bit lanes
+inline __m128i widenLow(__m128i x) {
+  return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+}
+
+inline __m128i widenHigh(__m128i x) {
+  return _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+}
+
+inline __m128i fixPcm24(__m128i data) {
+  __m128i min = _mm_set1_epi32(-0x800000);
+  return select(_mm_cmpeq_epi32(data, min), _mm_set1_epi32(0x800000), data);
+}
+
+// The operand order keeps NaN, as Math.min() and Math.max() do
+inline __m128 clamp(__m128 x) {
+  return _mm_max_ps(_mm_set1_ps(-1), _mm_min_ps(_mm_set1_ps(1), x));
+}
+
+inline __m128 clamp(__m128 x, float nan) {
+  return clamp(select(_mm_cmpeq_ps(x, x), x, _mm_set1_ps(nan)));
+}
+
+inline __m128i encodeVector8(__m128 x) {
+  __m128 v = clamp(x, -1);
+  __m128 magnitude = _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+  v = _mm_and_ps(v, _mm_cmpgt_ps(magnitude, _mm_set1_ps(Pcm8Epsilon)));
+
+  // (v * 0.5 + 0.5) * 255 + 0.5 = a + 128 - v / 2, with a = v * 128
+  __m128 a = _mm_mul_ps(v, _mm_set1_ps(128));
+  __m128i i = _mm_cvttps_epi32(a);
+  __m128 f = _mm_sub_ps(a, _mm_cvtepi32_ps(i));
+  __m128 h = _mm_mul_ps(v, _mm_set1_ps(0.5f));
+  return _mm_add_epi32(
+    _mm_add_epi32(i, _mm_set1_epi32(128)),
+    _mm_castps_si128(_mm_cmplt_ps(f, h))
+  );
+}
+
+// |halfUp| selects rounding of negative samples half up, rather than half
+// away from zero
+inline __m128i encodeVector(__m128 x, float max, bool halfUp) {
+  __m128 v = clamp(x, 0);
+  __m128 a = _mm_mul_ps(v, _mm_set1_ps(max));
+  __m128i i = _mm_cvttps_epi32(a);
+  __m128 f = _mm_sub_ps(a, _mm_cvtepi32_ps(i));
+  __m128 half = _mm_set1_ps(0.5f);
+
+  __m128 up = _mm_cmpge_ps(_mm_sub_ps(f, half), v);
+  __m128 down = _mm_cmplt_ps(_mm_add_ps(f, half), v);
+  __m128i pos = _mm_add_epi32(
+    _mm_sub_epi32(i, _mm_castps_si128(up)),
+    _mm_castps_si128(down)
+  );
+  __m128 below = halfUp ?
+    _mm_cmplt_ps(f, _mm_set1_ps(-0.5f)) :
+    _mm_cmple_ps(f, _mm_set1_ps(-0.5f));
+  __m128i neg = _mm_add_epi32(i, _mm_castps_si128(below));
+  return select(
+    _mm_castps_si128(_mm_cmplt_ps(v, _mm_setzero_ps())),
+    neg,
+    pos
+  );
+}
+
+// pcm32 needs more precision than a float has, so rounds 2 samples at a time
+inline __m128i encodeVector32(__m128d v) {
+  __m128d neg = _mm_cmplt_pd(v, _mm_setzero_pd());
+  __m128d a = _mm_mul_pd(
+    v,
+    select(neg, _mm_set1_pd(2147483648.0), _mm_set1_pd(2147483647.0))
+  );
+  return _mm_cvttpd_epi32(
+    _mm_add_pd(a, select(neg, _mm_set1_pd(-0.5), _mm_set1_pd(0.5)))
+  );
+}
+
+#endif
+
+//
+// Interleaved samples to and from float, |count| samples at a time
+//
+
+void decodePcm8(const uint8_t *in, float *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_NEON)
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t data = vreinterpretq_s16_u16(
+      vsubl_u8(vld1_u8(in + i), vdup_n_u8(128))
+    );
+    vst1q_f32(out + i, scale(vmovl_s16(vget_low_s16(data)), Pcm8));
+    vst1q_f32(out + i + 4, scale(vmovl_s16(vget_high_s16(data)), Pcm8));
+  }
+#elif defined(WAV_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(128);
+  for (; i + 16 <= count; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(x, zero), bias);
+    __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(x, zero), bias);
+    _mm_storeu_ps(out + i, scale(widenLow(low), Pcm8));
+    _mm_storeu_ps(out + i + 4, scale(widenHigh(low), Pcm8));
+    _mm_storeu_ps(out + i + 8, scale(widenLow(high), Pcm8));
+    _mm_storeu_ps(out + i + 12, scale(widenHigh(high), Pcm8));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = decode8(in[i]);
+  }
+}
+
+void decodePcm16(const uint8_t *in, float *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_NEON)
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t data = vreinterpretq_s16_u8(vld1q_u8(in + 2 * i));
+    vst1q_f32(out + i, scale(vmovl_s16(vget_low_s16(data)), Pcm16));
+    vst1q_f32(out + i + 4, scale(vmovl_s16(vget_high_s16(data)), Pcm16));
+  }
+#elif defined(WAV_SSE2)
+  for (; i + 8 <= count; i += 8) {
+    __m128i data =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * i));
+    _mm_storeu_ps(out + i, scale(widenLow(data), Pcm16));
+    _mm_storeu_ps(out + i + 4, scale(widenHigh(data), Pcm16));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = decode16(load16(in + 2 * i));
+  }
+}
+
+void decodePcm24(const uint8_t *in, float *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_NEON)
+  for (; i + 8 <= count; i += 8) {
+    uint8x8x3_t bytes = vld3_u8(in + 3 * i);
+    uint16x8_t low = vorrq_u16(
+      vmovl_u8(bytes.val[0]),
+      vshlq_n_u16(vmovl_u8(bytes.val[1]), 8)
+    );
+    int16x8_t high = vmovl_s8(vreinterpret_s8_u8(bytes.val[2]));
+    int32x4_t data0 = vorrq_s32(
+      vshlq_n_s32(vmovl_s16(vget_low_s16(high)), 16),
+      vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low)))
+    );
+    int32x4_t data1 = vorrq_s32(
+      vshlq_n_s32(vmovl_s16(vget_high_s16(high)), 16),
+      vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low)))
+    );
+    vst1q_f32(out + i, scale(fixPcm24(data0), Pcm24));
+    vst1q_f32(out + i + 4, scale(fixPcm24(data1), Pcm24));
+  }
+#elif defined(WAV_SSE2)
+  // Each sample is loaded with the byte after it, so the last one is left to
+  // the scalar loop
+  for (; i + 4 < count; i += 4) {
+    const uint8_t *p = in + 3 * i;
+    __m128i x = _mm_setr_epi32(
+      load32(p),
+      load32(p + 3),
+      load32(p + 6),
+      load32(p + 9)
+    );
+    __m128i data = _mm_srai_epi32(_mm_slli_epi32(x, 8), 8);
+    _mm_storeu_ps(out + i, scale(fixPcm24(data), Pcm24));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = decode24(in + 3 * i);
+  }
+}
+
+void decodePcm32(const uint8_t *in, float *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_SSE2)
+  // The double product rounds to the same float as the division
+  const __m128d neg = _mm_set1_pd(1 / 2147483648.0);
+  const __m128d pos = _mm_set1_pd(1 / 2147483647.0);
+  const __m128d zero = _mm_setzero_pd();
+  for (; i + 4 <= count; i += 4) {
+    __m128i data =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 4 * i));
+    __m128d low = _mm_cvtepi32_pd(data);
+    __m128d high = _mm_cvtepi32_pd(_mm_srli_si128(data, 8));
+    low = _mm_mul_pd(low, select(_mm_cmplt_pd(low, zero), neg, pos));
+    high = _mm_mul_pd(high, select(_mm_cmplt_pd(high, zero), neg, pos));
+    _mm_storeu_ps(out + i, _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high)));
+  }
+#endif
+  // NEON has no double precision vectors on ARMv7
+  for (; i < count; i++) {
+    out[i] = decode32(load32(in + 4 * i));
+  }
+}
+
+void decodePcm64f(const uint8_t *in, float *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    __m128d low = _mm_loadu_pd(reinterpret_cast<const double *>(in + 8 * i));
+    __m128d high =
+      _mm_loadu_pd(reinterpret_cast<const double *>(in + 8 * i + 16));
+    _mm_storeu_ps(out + i, _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high)));
+  }
+#endif
+  for (; i < count; i++) {
+    double x;
+    memcpy(&x, in + 8 * i, sizeof(x));
+    out[i] = x;
+  }
+}
+
+void encodePcm8(const float *in, uint8_t *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_NEON)
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t r = vcombine_u16(
+      vmovn_u32(encodeVector8(vld1q_f32(in + i))),
+      vmovn_u32(encodeVector8(vld1q_f32(in + i + 4)))
+    );
+    vst1_u8(out + i, vmovn_u16(r));
+  }
+#elif defined(WAV_SSE2)
+  for (; i + 16 <= count; i += 16) {
+    __m128i low = _mm_packs_epi32(
+      encodeVector8(_mm_loadu_ps(in + i)),
+      encodeVector8(_mm_loadu_ps(in + i + 4))
+    );
+    __m128i high = _mm_packs_epi32(
+      encodeVector8(_mm_loadu_ps(in + i + 8)),
+      encodeVector8(_mm_loadu_ps(in + i + 12))
+    );
+    _mm_storeu_si128(
+      reinterpret_cast<__m128i *>(out + i),
+      _mm_packus_epi16(low, high)
+    );
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = encode8(in[i]);
+  }
+}
+
+void encodePcm16(const float *in, uint8_t *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_NEON)
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t r = vcombine_s16(
+      vmovn_s32(encodeVector(vld1q_f32(in + i), 32768, false)),
+      vmovn_s32(encodeVector(vld1q_f32(in + i + 4), 32768, false))
+    );
+    vst1q_u8(out + 2 * i, vreinterpretq_u8_s16(r));
+  }
+#elif defined(WAV_SSE2)
+  for (; i + 8 <= count; i += 8) {
+    __m128i r = _mm_packs_epi32(
+      encodeVector(_mm_loadu_ps(in + i), 32768, false),
+      encodeVector(_mm_loadu_ps(in + i + 4), 32768, false)
+    );
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), r);
+  }
+#endif
+  for (; i < count; i++) {
+    int16_t x = encode16(in[i]);
+    memcpy(out + 2 * i, &x, sizeof(x));
+  }
+}
+
+void encodePcm24(const float *in, uint8_t *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_NEON)
+  for (; i + 8 <= count; i += 8) {
+    uint32x4_t r0 = vreinterpretq_u32_s32(
+      encodeVector(vld1q_f32(in + i), 8388608, true)
+    );
+    uint32x4_t r1 = vreinterpretq_u32_s32(
+      encodeVector(vld1q_f32(in + i + 4), 8388608, true)
+    );
+    uint16x8_t low = vcombine_u16(vmovn_u32(r0), vmovn_u32(r1));
+    uint16x8_t high = vcombine_u16(vshrn_n_u32(r0, 16), vshrn_n_u32(r1, 16));
+    uint8x8x3_t bytes;
+    bytes.val[0] = vmovn_u16(low);
+    bytes.val[1] = vshrn_n_u16(low, 8);
+    bytes.val[2] = vmovn_u16(high);
+    vst3_u8(out + 3 * i, bytes);
+  }
+#elif defined(WAV_SSE2)
+  // Each sample is stored with a byte that the next one overwrites, so the
+  // last one is left to the scalar loop
+  for (; i + 4 < count; i += 4) {
+    __m128i r = encodeVector(_mm_loadu_ps(in + i), 8388608, true);
+    uint8_t *p = out + 3 * i;
+    for (int k = 0; k < 4; k++) {
+      int32_t x = _mm_cvtsi128_si32(r);
+      memcpy(p + 3 * k, &x, sizeof(x));
+      r = _mm_srli_si128(r, 4);
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    encode24(in[i], out + 3 * i);
+  }
+}
+
+void encodePcm32(const float *in, uint8_t *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    __m128 v = clamp(_mm_loadu_ps(in + i), 0);
+    __m128i r = _mm_unpacklo_epi64(
+      encodeVector32(_mm_cvtps_pd(v)),
+      encodeVector32(_mm_cvtps_pd(_mm_movehl_ps(v, v)))
+    );
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * i), r);
+  }
+#endif
+  // NEON has no double precision vectors on ARMv7
+  for (; i < count; i++) {
+    int32_t x = encode32(in[i]);
+    memcpy(out + 4 * i, &x, sizeof(x));
+  }
+}
+
+void encodePcm32f(const float *in, uint8_t *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_NEON)
+  for (; i + 4 <= count; i += 4) {
+    vst1q_u8(
+      out + 4 * i,
+      vreinterpretq_u8_f32(clampBits(vld1q_f32(in + i)))
+    );
+  }
+#elif defined(WAV_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(reinterpret_cast<float *>(out + 4 * i), clamp(_mm_loadu_ps(in + i)));
+  }
+#endif
+  for (; i < count; i++) {
+    float x = clamp(in[i]);
+    memcpy(out + 4 * i, &x, sizeof(x));
+  }
+}
+
+void encodePcm64f(const float *in, uint8_t *out, size_t count) {
+  size_t i = 0;
+#if defined(WAV_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    __m128 v = clamp(_mm_loadu_ps(in + i));
+    double *p = reinterpret_cast<double *>(out + 8 * i);
+    _mm_storeu_pd(p, _mm_cvtps_pd(v));
+    _mm_storeu_pd(p + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+#endif
+  for (; i < count; i++) {
+    double x = clamp(in[i]);
+    memcpy(out + 8 * i, &x, sizeof(x));
+  }
+}
+
+void toFloat(Format format, const uint8_t *in, float *out, size_t count) {
+  switch (format) {
+  case PCM8:
+    decodePcm8(in, out, count);
+    break;
+  case PCM16:
+    decodePcm16(in, out, count);
+    break;
+  case PCM24:
+    decodePcm24(in, out, count);
+    break;
+  case PCM32:
+    decodePcm32(in, out, count);
+    break;
+  case PCM32F:
+    memcpy(out, in, count * sizeof(float));
+    break;
+  case PCM64F:
+    decodePcm64f(in, out, count);
+    break;
+  }
+}
+
+void fromFloat(Format format, const float *in, uint8_t *out, size_t count) {
+  switch (format) {
+  case PCM8:
+    encodePcm8(in, out, count);
+    break;
+  case PCM16:
+    encodePcm16(in, out, count);
+    break;
+  case PCM24:
+    encodePcm24(in, out, count);
+    break;
+  case PCM32:
+    encodePcm32(in, out, count);
+    break;
+  case PCM32F:
+    encodePcm32f(in, out, count);
+    break;
+  case PCM64F:
+    encodePcm64f(in, out, count);
+    break;
+  }
+}
+
+//
+// Interleaved to planar and back, |frames| from |offset| of each channel
+//
+
+void deinterleave(
+  const float *in,
+  float *const *out,
+  size_t offset,
+  int channels,
+  size_t frames
+) {
+  if (channels == 2) {
+    float *left = out[0] + offset;
+    float *right = out[1] + offset;
+    size_t i = 0;
+#if defined(WAV_NEON)
+    for (; i + 4 <= frames; i += 4) {
+      float32x4x2_t x = vld2q_f32(in + 2 * i);
+      vst1q_f32(left + i, x.val[0]);
+      vst1q_f32(right + i, x.val[1]);
+    }
+#elif defined(WAV_SSE2)
+    for (; i + 4 <= frames; i += 4) {
+      __m128 a = _mm_loadu_ps(in + 2 * i);
+      __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+      _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#endif
+    for (; i < frames; i++) {
+      left[i] = in[2 * i];
+      right[i] = in[2 * i + 1];
+    }
+    return;
+  }
+
+  for (int ch = 0; ch < channels; ch++) {
+    float *channel = out[ch] + offset;
+    for (size_t i = 0; i < frames; i++) {
+      channel[i] = in[i * channels + ch];
+    }
+  }
+}
+
+void interleave(
+  const float *const *in,
+  size_t offset,
+  int channels,
+  size_t frames,
+  float *out
+) {
+  if (channels == 2) {
+    const float *left = in[0] + offset;
+    const float *right = in[1] + offset;
+    size_t i = 0;
+#if defined(WAV_NEON)
+    for (; i + 4 <= frames; i += 4) {
+      float32x4x2_t x;
+      x.val[0] = vld1q_f32(left + i);
+      x.val[1] = vld1q_f32(right + i);
+      vst2q_f32(out + 2 * i, x);
+    }
+#elif defined(WAV_SSE2)
+    for (; i + 4 <= frames; i += 4) {
+      __m128 l = _mm_loadu_ps(left + i);
+      __m128 r = _mm_loadu_ps(right + i);
+      _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+      _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+#endif
+    for (; i < frames; i++) {
+      out[2 * i] = left[i];
+      out[2 * i + 1] = right[i];
+    }
+    return;
+  }
+
+  for (int ch = 0; ch < channels; ch++) {
+    const float *channel = in[ch] + offset;
+    for (size_t i = 0; i < frames; i++) {
+      out[i * channels + ch] = channel[i];
+    }
+  }
+}
+
+} // anonymous namespace
+
+size_t formatBytes(Format format) {
+  switch (format) {
+  case PCM8:
+    return 1;
+  case PCM16:
+    return 2;
+  case PCM24:
+    return 3;
+  case PCM32:
+  case PCM32F:
+    return 4;
+  case PCM64F:
+    return 8;
+  }
+  return 0;
+}
+
+void decode(
+  Format format,
+  const uint8_t *in,
+  float *const *out,
+  int channels,
+  size_t frames
+) {
+  if (channels == 1) {
+    toFloat(format, in, out[0], frames);
+    return;
+  }
+
+  const size_t frameBytes = channels * formatBytes(format);
+  const size_t block = std::max<size_t>(BlockSamples / channels, 1);
+  std::vector<float> scratch(std::min(frames, block) * channels);
+  for (size_t frame = 0; frame < frames; frame += block) {
+    size_t count = std::min(block, frames - frame);
+    toFloat(format, in + frame * frameBytes, scratch.data(), count * channels);
+    deinterleave(scratch.data(), out, frame, channels, count);
+  }
+}
+
+void encode(
+  Format format,
+  const float *const *in,
+  int channels,
+  size_t frames,
+  uint8_t *out
+) {
+  if (channels == 1) {
+    fromFloat(format, in[0], out, frames);
+    return;
+  }
+
+  const size_t frameBytes = channels * formatBytes(format);
+  const size_t block = std::max<size_t>(BlockSamples / channels, 1);
+  std::vector<float> scratch(std::min(frames, block) * channels);
+  for (size_t frame = 0; frame < frames; frame += block) {
+    size_t count = std::min(block, frames - frame);
+    interleave(in, frame, channels, count, scratch.data());
+    fromFloat(format, scratch.data(), out + frame * frameBytes, count * channels);
+  }
+}
+
+} // namespace wav
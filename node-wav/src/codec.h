@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace wav {
+
+enum Format {
+  PCM8,
+  PCM16,
+  PCM24,
+  PCM32,
+  PCM32F,
+  PCM64F,
+};
+
+// Bytes per sample of |format|
+size_t formatBytes(Format format);
+
+/**
+ * Decodes |frames| interleaved frames of |channels| samples in |format| from
+ * |in| into the planar channel buffers |out|.
+ *
+ * The results are bit for bit those of the JavaScript decoders in
+ * lib/index.js, rounding included, computed 4 or more samples at a time with
+ * NEON or SSE2 where available.
+ */
+void decode(
+  Format format,
+  const uint8_t *in,
+  float *const *out,
+  int channels,
+  size_t frames
+);
+
+/**
+ * Encodes |frames| frames of the planar channel buffers |in| into |out| as
+ * interleaved samples in |format|, clamping to [-1, 1] and rounding exactly
+ * as the JavaScript encoders in lib/index.js do.
+ */
+void encode(
+  Format format,
+  const float *const *in,
+  int channels,
+  size_t frames,
+  uint8_t *out
+);
+
+} // namespace wav
@@ -0,0 +1,137 @@
+/**
+ * @noflow
+ */
+
+const assert = require('assert');
+const wav = require('../');
+
+// Random samples, a little beyond [-1, 1], mixed with those that round or
+// clamp in special ways
+function makeTestData(channels, length) {
+  const special = [
+    0, -0, 1, -1, 1.5, -1.5, Infinity, -Infinity, NaN,
+    0.5, -0.5, 1e-20, -1e-20, 1e-45, -1e-45,
+    0.5 / 32767, -0.5 / 32768, 0.5 / 8388607, -0.5 / 8388608,
+  ];
+  let data = [];
+  for (let ch = 0; ch < channels; ++ch) {
+    data[ch] = new Float32Array(length);
+    for (let n = 0; n < length; ++n) {
+      data[ch][n] = n % 7 === 0 ?
+        special[(n / 7 + ch) % special.length] :
+        Math.random() * 2.2 - 1.1;
+    }
+  }
+  return data;
+}
+
+function encode(native, channelData, opts) {
+  assert.equal(wav.useNative(native), native);
+  return wav.encode(channelData, opts);
+}
+
+function decode(native, buffer) {
+  assert.equal(wav.useNative(native), native);
+  return wav.decode(buffer);
+}
+
+// Same samples, taking any NaN as equal to any other
+function assertSameSamples(actual, expected, message) {
+  assert.equal(actual.length, expected.length, message);
+  for (let n = 0; n < expected.length; ++n) {
+    if (!Object.is(actual[n], expected[n])) {
+      assert.fail(actual[n], expected[n], `${message}, sample ${n}`, '===');
+    }
+  }
+}
+
+function assertSameData(actual, expected, message) {
+  assert.equal(actual.length, expected.length, message);
+  for (let ch = 0; ch < expected.length; ++ch) {
+    assertSameSamples(actual[ch], expected[ch], message);
+  }
+}
+
+suite('native', () => {
+  suiteSetup(function() {
+    if (!wav.useNative(true)) {
+      this.skip();
+    }
+  });
+
+  suiteTeardown(() => {
+    wav.useNative(true);
+  });
+
+  test('native codecs match the JavaScript ones', () => {
+    // Lengths that leave samples for the scalar loops
+    const length = 1000 * 3 + 7;
+    [1, 2, 3].forEach((channels) => {
+      const channelData = makeTestData(channels, length);
+      [8, 16, 24, 32, '32f'].forEach((bitDepth) => {
+        let opts = {
+          sampleRate: 44100,
+          bitDepth: bitDepth === '32f' ? 32 : bitDepth,
+          float: bitDepth === '32f',
+        };
+        let message = `${channels} channels, bitDepth=${bitDepth}`;
+        let expected = encode(false, channelData, opts);
+        let actual = encode(true, channelData, opts);
+        if (opts.float) {
+          assertSameSamples(
+            new Float32Array(actual.buffer, actual.byteOffset + 44),
+            new Float32Array(expected.buffer, expected.byteOffset + 44),
+            `encode: ${message}`
+          );
+        } else {
+          assert.ok(actual.equals(expected), `encode: ${message}`);
+        }
+
+        assertSameData(
+          decode(true, expected).channelData,
+          decode(false, expected).channelData,
+          `decode: ${message}`
+        );
+      });
+    });
+  });
+
+  test('native pcm64f decoder', () => {
+    const length = 1001;
+    const channels = 2;
+    let samples = new Float64Array(length * channels);
+    for (let n = 0; n < samples.length; ++n) {
+      samples[n] = Math.random() * 2 - 1;
+    }
+    let buffer = wav.encodeRaw(Buffer.from(samples.buffer), {
+      sampleRate: 16000,
+      channels,
+      float: true,
+    });
+    // encodeRaw() only writes 32 bit float headers
+    buffer.writeUInt32LE(16000 * channels * 8, 28);
+    buffer.writeUInt16LE(channels * 8, 32);
+    buffer.writeUInt16LE(64, 34);
+
+    // The JavaScript decoder needs the data 8 byte aligned, which it is not
+    // behind a 44 byte header
+    let expected = [];
+    for (let ch = 0; ch < channels; ++ch) {
+      expected[ch] = new Float32Array(length);
+      for (let n = 0; n < length; ++n) {
+        expected[ch][n] = samples[n * channels + ch];
+      }
+    }
+    assertSameData(decode(true, buffer).channelData, expected, 'decode: pcm64f');
+  });
+
+  test('truncated data falls back to the JavaScript decoder', () => {
+    let buffer = encode(true, makeTestData(2, 100), {sampleRate: 16000, bitDepth: 16});
+    let truncated = buffer.slice(0, buffer.length - 10);
+    assertSameData(
+      decode(true, truncated).channelData,
+      decode(false, truncated).channelData,
+      'decode: truncated'
+    );
+  });
+});
@@ -0,0 +1,159 @@
+/**
+ * @noflow
+ */
+
+const assert = require('assert');
+const fs = require('mz/fs');
+const os = require('os');
+const path = require('path');
+const wav = require('../');
+
+function makeTestData(channels, length) {
+  let data = [];
+  for (let ch = 0; ch < channels; ++ch) {
+    data[ch] = new Float32Array(length);
+    for (let n = 0; n < length; ++n) {
+      data[ch][n] = Math.random() * 2 - 1; // use [-1, 1] range
+    }
+  }
+  return data;
+}
+
+// |buffer| with a LIST chunk between the 'fmt ' and 'data' chunks, sized to
+// keep the data 8 byte aligned for the JavaScript decoders of decode()
+function withListChunk(buffer) {
+  let list = Buffer.alloc(8 + 28);
+  list.write('LIST', 0, 'ascii');
+  list.writeUInt32LE(28, 4);
+  list.write('INFOISFT', 8, 'ascii');
+  let result = Buffer.concat([buffer.slice(0, 36), list, buffer.slice(36)]);
+  result.writeUInt32LE(result.length - 8, 4);
+  return result;
+}
+
+function decodeStream(buffer, pieceSizes) {
+  return new Promise((resolve, reject) => {
+    let stream = new wav.DecodeStream();
+    let format = null;
+    let blocks = [];
+    stream.on('format', (f) => {
+      format = f;
+    });
+    stream.on('data', (channelData) => blocks.push(channelData));
+    stream.on('error', reject);
+    stream.on('end', () => resolve({format, blocks}));
+
+    let pos = 0;
+    for (let i = 0; pos < buffer.length; ++i) {
+      let size = pieceSizes[i % pieceSizes.length];
+      stream.write(buffer.slice(pos, pos + size));
+      pos += size;
+    }
+    stream.end();
+  });
+}
+
+// Concatenates the samples of each channel over |blocks|
+function join(blocks, channels) {
+  let result = [];
+  for (let ch = 0; ch < channels; ++ch) {
+    let length = blocks.reduce((sum, block) => sum + block[ch].length, 0);
+    result[ch] = new Float32Array(length);
+    let pos = 0;
+    for (let block of blocks) {
+      result[ch].set(block[ch], pos);
+      pos += block[ch].length;
+    }
+  }
+  return result;
+}
+
+function assertSameData(actual, expected, message) {
+  assert.equal(actual.length, expected.length, message);
+  for (let ch = 0; ch < expected.length; ++ch) {
+    assert.deepEqual(Array.from(actual[ch]), Array.from(expected[ch]), message);
+  }
+}
+
+function tempFile(name) {
+  return path.join(os.tmpdir(), `node-wav-${process.pid}-${name}`);
+}
+
+suite('stream', () => {
+  test('DecodeStream decodes chunks split across writes', async () => {
+    const channelData = makeTestData(2, 1000);
+    for (let bitDepth of [8, 16, 24, 32]) {
+      let buffer = withListChunk(wav.encode(channelData, {sampleRate: 16000, bitDepth}));
+      let expected = wav.decode(buffer);
+      for (let pieceSizes of [[1], [3, 7, 11], [4096]]) {
+        let {format, blocks} = await decodeStream(buffer, pieceSizes);
+        let message = `bitDepth=${bitDepth}, pieces of ${pieceSizes}`;
+        assert.deepEqual(format, {sampleRate: 16000, channels: 2, bitDepth, float: false}, message);
+        assertSameData(join(blocks, 2), expected.channelData, message);
+      }
+    }
+  });
+
+  test('DecodeStream fails on a file without data', async () => {
+    let buffer = wav.encode(makeTestData(1, 10), {sampleRate: 16000, bitDepth: 16});
+    await decodeStream(buffer.slice(0, 30), [7]).then(
+      () => assert.fail('decoded a truncated header'),
+      (err) => assert.equal(err.message, 'Failed to decode')
+    );
+  });
+
+  test('WavWriter output matches encode()', async () => {
+    const channelData = makeTestData(2, 1000);
+    const file = tempFile('writer.wav');
+    for (let opts of [{bitDepth: 16}, {bitDepth: 24}, {float: true}]) {
+      opts = Object.assign({sampleRate: 44100, channels: 2}, opts);
+      let writer = await wav.WavWriter.open(file, opts);
+      let writes = [];
+      for (let pos = 0; pos < 1000; pos += 300) {
+        writes.push(writer.write(channelData.map((data) => data.subarray(pos, pos + 300))));
+      }
+      await Promise.all(writes);
+      await writer.close();
+      let actual = await fs.readFile(file);
+      assert.ok(actual.equals(wav.encode(channelData, opts)), JSON.stringify(opts));
+    }
+
+    // A file closed without any samples still gets a valid header
+    let writer = await wav.WavWriter.open(file, {sampleRate: 16000});
+    await writer.close();
+    assert.equal(wav.decode(await fs.readFile(file)).channelData[0].length, 0);
+    await fs.unlink(file);
+  });
+
+  test('WavReader decodes any range of frames', async () => {
+    const channelData = makeTestData(3, 5000);
+    const file = tempFile('reader.wav');
+    let buffer = withListChunk(wav.encode(channelData, {sampleRate: 16000, bitDepth: 24}));
+    await fs.writeFile(file, buffer);
+    let expected = wav.decode(buffer).channelData;
+
+    let reader = await wav.WavReader.open(file);
+    assert.equal(reader.sampleRate, 16000);
+    assert.equal(reader.channels, 3);
+    assert.equal(reader.bitDepth, 24);
+    assert.equal(reader.length, 5000);
+
+    assertSameData(
+      await reader.read(1234, 100),
+      expected.map((data) => data.subarray(1234, 1334)),
+      'new buffers'
+    );
+
+    // Caller buffers bound the read, as does the end of the file
+    let output = [new Float32Array(50), new Float32Array(50), new Float32Array(50)];
+    let result = await reader.read(4980, 1000, output);
+    assert.equal(result[0].length, 20);
+    assert.equal(result[0].buffer, output[0].buffer);
+    assertSameData(result, expected.map((data) => data.subarray(4980)), 'caller buffers');
+    result = await reader.read(10, 1000, output);
+    assertSameData(result, expected.map((data) => data.subarray(10, 60)), 'caller buffers');
+
+    await reader.close();
+    await fs.unlink(file);
+  });
+});
@@ -0,0 +1,79 @@
+/**
+ * Times the native codecs against the JavaScript ones on a WAV file, by
+ * default five minutes of 24 bit stereo at 48kHz:
+ *
+ *   ../babel-run/babel-node tools/benchmark.js [file.wav]
+ *
+ * @noflow
+ */
+
+import fs from 'fs';
+import wav from '../';
+
+const ITERATIONS = 5;
+
+function makeTestFile() {
+  const sampleRate = 48000;
+  const length = 5 * 60 * sampleRate;
+  let channelData = [new Float32Array(length), new Float32Array(length)];
+  for (let i = 0; i < length; ++i) {
+    let t = i / sampleRate;
+    channelData[0][i] = 0.5 * Math.sin(2 * Math.PI * 440 * t) + 0.1 * (Math.random() - 0.5);
+    channelData[1][i] = 0.5 * Math.sin(2 * Math.PI * 660 * t) + 0.1 * (Math.random() - 0.5);
+  }
+  return wav.encode(channelData, {sampleRate, bitDepth: 24});
+}
+
+function time(fn) {
+  fn(); // Warm up
+  let best = Infinity;
+  for (let i = 0; i < ITERATIONS; ++i) {
+    let start = process.hrtime();
+    fn();
+    let [s, ns] = process.hrtime(start);
+    best = Math.min(best, s * 1e3 + ns / 1e6);
+  }
+  return best;
+}
+
+function run(name, buffer) {
+  let decoded = wav.decode(buffer);
+  let opts = {
+    sampleRate: decoded.sampleRate,
+    bitDepth: decoded.bitDepth,
+    float: decoded.float,
+  };
+  let seconds = decoded.channelData[0].length / decoded.sampleRate;
+  console.log(
+    `${name}: ${seconds.toFixed(1)}s, ${decoded.channels} channels, ` +
+    `${decoded.bitDepth} bit${decoded.float ? ' float' : ''}, ${decoded.sampleRate}Hz`
+  );
+
+  let results = {};
+  for (let backend of ['js', 'native']) {
+    if (wav.useNative(backend === 'native') !== (backend === 'native')) {
+      console.log('  native codecs not built, run node-gyp rebuild');
+      break;
+    }
+    results[backend] = {
+      decode: time(() => wav.decode(buffer)),
+      encode: time(() => wav.encode(decoded.channelData, opts)),
+    };
+  }
+  wav.useNative(true);
+
+  for (let op of ['decode', 'encode']) {
+    let line = `  ${op}: js ${results.js[op].toFixed(1)}ms`;
+    if (results.native) {
+      line += `, native ${results.native[op].toFixed(1)}ms` +
+        ` (${(results.js[op] / results.native[op]).toFixed(1)}x)`;
+    }
+    console.log(line);
+  }
+}
+
+if (process.argv[2]) {
+  run(process.argv[2], fs.readFileSync(process.argv[2]));
+} else {
+  run('generated', makeTestFile());
+}